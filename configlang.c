@@ -1,14 +1,47 @@
 /**
  * configlang.c
- * 
+ *
  * Implementation of embedded configuration language
  */
 
+#if !defined(_WIN32) && !defined(_POSIX_C_SOURCE)
+#define _POSIX_C_SOURCE 200809L
+#endif
+
 #include "configlang.h"
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
-#include <ctype.h>
+#include <stdint.h>
+#include <limits.h>
+
+#if defined(__SSE2__) && defined(__GNUC__)
+#include <emmintrin.h>
+#define CFG_USE_SSE2 1
+#endif
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#define CFG_USE_MMAP 1
+#endif
+
+/* Direct-threaded dispatch in the executor needs the GCC/Clang &&label
+ * extension; define CFG_NO_COMPUTED_GOTO to force the portable switch */
+#if defined(__GNUC__) && !defined(CFG_NO_COMPUTED_GOTO)
+#define CFG_USE_COMPUTED_GOTO 1
+#endif
+
+/* Inlining hints for the per-byte lexer helpers; no-ops off GCC/Clang */
+#if defined(__GNUC__)
+#define CFG_ALWAYS_INLINE inline __attribute__((always_inline))
+#define CFG_HOT __attribute__((hot))
+#else
+#define CFG_ALWAYS_INLINE
+#define CFG_HOT
+#endif
 
 /* Configuration constants */
 #define MAX_VARIABLES 128
@@ -23,46 +56,68 @@ typedef enum {
     VAR_TYPE_STRING
 } VarType;
 
-/* Variable storage */
-typedef struct {
-    char name[MAX_VAR_NAME];
-    VarType type;
-    int is_const;
-    union {
-        int int_val;
-        char str_val[MAX_STRING_VALUE];
-    } value;
-    int in_use;
-} Variable;
+/* Longest string stored inline in a VarValue; chosen so the sso arm fills
+ * the padding the pointer arm already forces, keeping the union at 24 bytes */
+#define CFG_SSO_MAX 21
+
+/* Variable value storage - short strings (the common case for config
+ * values) live in the inline buffer and never touch malloc; longer ones
+ * either borrow the program's string pool directly (no allocation and no
+ * copy) or, rarely, own a heap copy. The length field is the first member
+ * of both string arms, so str.len is valid for either, and
+ * len <= CFG_SSO_MAX discriminates inline from pointer storage; borrowed
+ * is only meaningful for pointer storage. */
+typedef union {
+    int int_val;
+    struct {
+        uint16_t len;
+        uint8_t borrowed;   /* data points into a program pool, not owned */
+        char* data;
+    } str;
+    struct {
+        uint16_t len;
+        char buf[CFG_SSO_MAX + 1];
+    } sso;
+} VarValue;
 
-/* Token types */
+/* Read a string value regardless of where it is stored */
+#define VALUE_STR(v) ((v)->str.len <= CFG_SSO_MAX ? (v)->sso.buf : (v)->str.data)
+
+/* Token types - explicit discriminants so all values fit a uint8_t and the
+ * hottest tokens get the smallest immediates; TOK_GT..TOK_NEQ must stay
+ * contiguous for the comparison mask table in eval_condition */
 typedef enum {
-    TOK_EOF,
-    TOK_IDENT,
-    TOK_NUMBER,
-    TOK_STRING,
-    TOK_SET,
-    TOK_CONST,
-    TOK_IF,
-    TOK_LBRACE,
-    TOK_RBRACE,
-    TOK_ASSIGN,
-    TOK_GT,
-    TOK_LT,
-    TOK_GTE,
-    TOK_LTE,
-    TOK_EQ,
-    TOK_NEQ,
-    TOK_NEWLINE,
-    TOK_MULTILINE_START,
-    TOK_ERROR
+    TOK_IDENT   = 0,
+    TOK_NUMBER  = 1,
+    TOK_STRING  = 2,
+    TOK_NEWLINE = 3,
+    TOK_SET     = 4,
+    TOK_CONST   = 5,
+    TOK_IF      = 6,
+    TOK_LBRACE  = 7,
+    TOK_RBRACE  = 8,
+    TOK_ASSIGN  = 9,
+    TOK_GT      = 10,
+    TOK_LT      = 11,
+    TOK_GTE     = 12,
+    TOK_LTE     = 13,
+    TOK_EQ      = 14,
+    TOK_NEQ     = 15,
+    TOK_MULTILINE_START = 16,
+    TOK_EOF     = 17,
+    TOK_ERROR   = 18
 } TokenType;
 
-/* Token structure */
+/* Token structure - payloads reference the source buffer directly instead
+ * of being copied into an inline buffer; the input stays live for the whole
+ * parse, and a copy is only made when a value is stored into a variable.
+ * The type tag is stored as a byte (C99 enums default to int width) */
 typedef struct {
-    TokenType type;
-    char text[MAX_STRING_VALUE];
+    const char* start;  /* payload slice into the source buffer */
+    uint32_t len;       /* length of the slice */
     int int_value;
+    uint32_t hash;      /* FNV-1a of the slice, filled for TOK_IDENT */
+    uint8_t type;       /* a TokenType value */
 } Token;
 
 /* Lexer state */
@@ -70,13 +125,40 @@ typedef struct {
     const char* input;
     size_t pos;
     size_t length;
-    int line_number;
 } Lexer;
 
-/* ConfigLang structure */
+/* Compiled form of one source buffer - defined with the compiler below */
+typedef struct CfgProgram CfgProgram;
+
+/* Number of compiled programs retained per instance */
+#define CFG_PROGRAM_CACHE 8
+
+/* ConfigLang structure
+ *
+ * Variable names are interned: an open-addressed map (MAX_VARIABLES is a
+ * power of two, so probing can mask) resolves name hash to a dense id, and
+ * the per-variable parallel arrays are packed in creation order and indexed
+ * by that id. A lookup touches only the small map arrays, every later access
+ * is a direct array index, and full walks (save, destroy) iterate exactly
+ * var_count entries with no gaps. */
 struct ConfigLang {
-    Variable variables[MAX_VARIABLES];
+    uint8_t slot_id[MAX_VARIABLES];    /* dense id + 1; 0 marks an empty slot */
+    uint32_t slot_hash[MAX_VARIABLES];
+    char names[MAX_VARIABLES][MAX_VAR_NAME];
+    VarType types[MAX_VARIABLES];
+    uint8_t is_const[MAX_VARIABLES];
+    VarValue values[MAX_VARIABLES];
     int var_count;
+    /* Content-hash keyed cache of compiled programs: reloading the same
+     * source bytes skips lexing and parsing and just re-executes */
+    CfgProgram* progs[CFG_PROGRAM_CACHE];
+    uint32_t prog_stamp;
+    unsigned opt_flags;                /* CFG_OPT_* passes for new compiles */
+    /* Pools of evicted programs that variables still hold views into;
+     * freed once the variables are gone (cfg_reset / cfg_destroy) */
+    char** retained_pools;
+    int retained_count;
+    int retained_cap;
     char error_msg[MAX_ERROR_MSG];
     int last_error;
 };
@@ -94,113 +176,341 @@ static void set_error(ConfigLang* cfg, int error_code, const char* msg, int line
     }
 }
 
-static Variable* find_variable(ConfigLang* cfg, const char* name) {
-    for (int i = 0; i < MAX_VARIABLES; i++) {
-        if (cfg->variables[i].in_use && strcmp(cfg->variables[i].name, name) == 0) {
-            return &cfg->variables[i];
+/* FNV-1a hash of a variable name */
+static uint32_t hash_name(const char* name) {
+    uint32_t h = 2166136261u;
+    while (*name) {
+        h = (h ^ (unsigned char)*name++) * 0x01000193u;
+    }
+    return h;
+}
+
+/* Both return a dense variable id indexing the parallel arrays, or -1 */
+
+/* Release a slot's heap string, if it owns one */
+static void clear_value(ConfigLang* cfg, int slot) {
+    if (cfg->types[slot] == VAR_TYPE_STRING) {
+        if (cfg->values[slot].str.len > CFG_SSO_MAX && !cfg->values[slot].str.borrowed) {
+            free(cfg->values[slot].str.data);
         }
+        cfg->values[slot].str.data = NULL;
+        cfg->values[slot].str.len = 0;
+        cfg->values[slot].str.borrowed = 0;
     }
-    return NULL;
 }
 
-static Variable* create_variable(ConfigLang* cfg, const char* name) {
-    /* Find first unused slot */
+/* Store a string value in a slot: inline when it fits, heap otherwise */
+static int store_string_value(ConfigLang* cfg, int slot, const char* src, size_t len) {
+    if (len > MAX_STRING_VALUE - 1) {
+        len = MAX_STRING_VALUE - 1;
+    }
+    if (len <= CFG_SSO_MAX) {
+        /* Stage through a temporary so self-assignment from the slot's own
+         * storage stays safe, then release the old value */
+        char tmp[CFG_SSO_MAX + 1];
+        memcpy(tmp, src, len);
+        tmp[len] = '\0';
+        clear_value(cfg, slot);
+        cfg->types[slot] = VAR_TYPE_STRING;
+        cfg->values[slot].sso.len = (uint16_t)len;
+        memcpy(cfg->values[slot].sso.buf, tmp, len + 1);
+        return ERR_CFG_OK;
+    }
+    char* data = (char*)malloc(len + 1);
+    if (!data) {
+        return ERR_CFG_OUT_OF_MEMORY;
+    }
+    memcpy(data, src, len);
+    data[len] = '\0';
+    clear_value(cfg, slot);
+    cfg->types[slot] = VAR_TYPE_STRING;
+    cfg->values[slot].str.len = (uint16_t)len;
+    cfg->values[slot].str.borrowed = 0;
+    cfg->values[slot].str.data = data;
+    return ERR_CFG_OK;
+}
+
+static int find_variable(ConfigLang* cfg, const char* name, size_t len, uint32_t hash) {
+    if (len > MAX_VAR_NAME - 1) {
+        return -1;
+    }
     for (int i = 0; i < MAX_VARIABLES; i++) {
-        if (!cfg->variables[i].in_use) {
-            strncpy(cfg->variables[i].name, name, MAX_VAR_NAME - 1);
-            cfg->variables[i].name[MAX_VAR_NAME - 1] = '\0';
-            cfg->variables[i].in_use = 1;
-            cfg->variables[i].is_const = 0;
-            if (cfg->var_count <= i) {
-                cfg->var_count = i + 1;
+        int slot = (int)((hash + i) & (MAX_VARIABLES - 1));
+        if (!cfg->slot_id[slot]) {
+            return -1;
+        }
+        /* Compare the cached hash first; memcmp only on a hash match */
+        if (cfg->slot_hash[slot] == hash) {
+            int id = cfg->slot_id[slot] - 1;
+            if (memcmp(cfg->names[id], name, len) == 0 &&
+                cfg->names[id][len] == '\0') {
+                return id;
             }
-            return &cfg->variables[i];
         }
     }
-    return NULL;
+    return -1;
+}
+
+static int create_variable(ConfigLang* cfg, const char* name, size_t len, uint32_t hash) {
+    if (cfg->var_count >= MAX_VARIABLES) {
+        return -1;
+    }
+    if (len > MAX_VAR_NAME - 1) {
+        len = MAX_VAR_NAME - 1;
+    }
+    for (int i = 0; i < MAX_VARIABLES; i++) {
+        int slot = (int)((hash + i) & (MAX_VARIABLES - 1));
+        if (!cfg->slot_id[slot]) {
+            int id = cfg->var_count++;
+            cfg->slot_id[slot] = (uint8_t)(id + 1);
+            cfg->slot_hash[slot] = hash;
+            memcpy(cfg->names[id], name, len);
+            cfg->names[id][len] = '\0';
+            cfg->is_const[id] = 0;
+            cfg->types[id] = VAR_TYPE_INT;
+            cfg->values[id].int_val = 0;
+            return id;
+        }
+    }
+    return -1;
 }
 
 /* ========================================================================
  * LEXER
+ *
+ * Hand-rolled equivalent of a generated DFA scanner: dispatch on the first
+ * byte is one class-table lookup, runs (whitespace, numbers, identifiers,
+ * strings, multiline payloads) are consumed by tight per-class loops, and
+ * keywords resolve with a length switch plus one memcmp. A re2c/flex stage
+ * would buy the same two-lookups-per-byte shape at the cost of a generator
+ * dependency and a generated TU, which this single-file library avoids.
  * ======================================================================== */
 
-static void lexer_init(Lexer* lex, const char* input) {
+/* Character dispatch classes for lexer_next_token - one table lookup picks
+ * the token sub-routine instead of a chain of per-character compares.
+ * LC_DIGIT and LC_IDENT are the two highest values so that "identifier
+ * continuation" (alnum or '_') is a single >= compare on the class. */
+enum {
+    LC_OTHER = 0,
+    LC_SPACE,
+    LC_NEWLINE,
+    LC_HASH,
+    LC_QUOTE,
+    LC_MINUS,
+    LC_ASSIGN,
+    LC_GT,
+    LC_LT,
+    LC_BANG,
+    LC_LBRACE,
+    LC_RBRACE,
+    LC_DIGIT,
+    LC_IDENT
+};
+
+/* Built at compile time: the table is const data in a read-only section,
+ * so concurrent lexing on independent instances shares it without any
+ * initialization ordering to get wrong */
+static const uint8_t lex_class[256] = {
+    ['0'] = LC_DIGIT, ['1'] = LC_DIGIT, ['2'] = LC_DIGIT, ['3'] = LC_DIGIT,
+    ['4'] = LC_DIGIT, ['5'] = LC_DIGIT, ['6'] = LC_DIGIT, ['7'] = LC_DIGIT,
+    ['8'] = LC_DIGIT, ['9'] = LC_DIGIT, ['a'] = LC_IDENT, ['b'] = LC_IDENT,
+    ['c'] = LC_IDENT, ['d'] = LC_IDENT, ['e'] = LC_IDENT, ['f'] = LC_IDENT,
+    ['g'] = LC_IDENT, ['h'] = LC_IDENT, ['i'] = LC_IDENT, ['j'] = LC_IDENT,
+    ['k'] = LC_IDENT, ['l'] = LC_IDENT, ['m'] = LC_IDENT, ['n'] = LC_IDENT,
+    ['o'] = LC_IDENT, ['p'] = LC_IDENT, ['q'] = LC_IDENT, ['r'] = LC_IDENT,
+    ['s'] = LC_IDENT, ['t'] = LC_IDENT, ['u'] = LC_IDENT, ['v'] = LC_IDENT,
+    ['w'] = LC_IDENT, ['x'] = LC_IDENT, ['y'] = LC_IDENT, ['z'] = LC_IDENT,
+    ['A'] = LC_IDENT, ['B'] = LC_IDENT, ['C'] = LC_IDENT, ['D'] = LC_IDENT,
+    ['E'] = LC_IDENT, ['F'] = LC_IDENT, ['G'] = LC_IDENT, ['H'] = LC_IDENT,
+    ['I'] = LC_IDENT, ['J'] = LC_IDENT, ['K'] = LC_IDENT, ['L'] = LC_IDENT,
+    ['M'] = LC_IDENT, ['N'] = LC_IDENT, ['O'] = LC_IDENT, ['P'] = LC_IDENT,
+    ['Q'] = LC_IDENT, ['R'] = LC_IDENT, ['S'] = LC_IDENT, ['T'] = LC_IDENT,
+    ['U'] = LC_IDENT, ['V'] = LC_IDENT, ['W'] = LC_IDENT, ['X'] = LC_IDENT,
+    ['Y'] = LC_IDENT, ['Z'] = LC_IDENT, ['_'] = LC_IDENT, [' '] = LC_SPACE,
+    ['\t'] = LC_SPACE, ['\r'] = LC_SPACE, ['\n'] = LC_NEWLINE, ['#'] = LC_HASH,
+    ['"'] = LC_QUOTE, ['-'] = LC_MINUS, ['='] = LC_ASSIGN, ['>'] = LC_GT,
+    ['<'] = LC_LT, ['!'] = LC_BANG, ['{'] = LC_LBRACE, ['}'] = LC_RBRACE,
+};
+
+/* ctype replacements backed by the class table - no locale, no TLS lookup,
+ * and parsing stays deterministic regardless of the process locale */
+#define LEX_IS_DIGIT(c)      (lex_class[(unsigned char)(c)] == LC_DIGIT)
+#define LEX_IS_IDENT_CONT(c) (lex_class[(unsigned char)(c)] >= LC_DIGIT)
+
+static void lexer_init(Lexer* lex, const char* input, size_t length) {
     lex->input = input;
     lex->pos = 0;
-    lex->length = strlen(input);
-    lex->line_number = 1;
+    lex->length = length;
 }
 
-static char lexer_peek(Lexer* lex) {
+/* Line number at the current position, computed only when an error is
+ * actually reported. Parsing stops at the first error, so counting newlines
+ * lazily here is cheaper than maintaining a counter on every byte consumed
+ * in lexer_advance. */
+static int lexer_line(const Lexer* lex) {
+    int line = 1;
+    const char* p = lex->input;
+    const char* end = lex->input + lex->pos;
+    while (p < end && (p = memchr(p, '\n', (size_t)(end - p))) != NULL) {
+        line++;
+        p++;
+    }
+    return line;
+}
+
+static CFG_ALWAYS_INLINE char lexer_peek(const Lexer* restrict lex) {
     if (lex->pos >= lex->length) return '\0';
     return lex->input[lex->pos];
 }
 
-static char lexer_advance(Lexer* lex) {
+static CFG_ALWAYS_INLINE char lexer_advance(Lexer* restrict lex) {
     if (lex->pos >= lex->length) return '\0';
-    char c = lex->input[lex->pos++];
-    if (c == '\n') lex->line_number++;
-    return c;
+    return lex->input[lex->pos++];
 }
 
-static void lexer_skip_whitespace(Lexer* lex) {
-    while (lexer_peek(lex) == ' ' || lexer_peek(lex) == '\t' || lexer_peek(lex) == '\r') {
+static CFG_HOT void lexer_skip_whitespace(Lexer* restrict lex) {
+#ifdef CFG_USE_SSE2
+    /* Scan 16 bytes at a time: the movemask marks whitespace bytes, so the
+     * first zero bit is the first non-whitespace byte. Whitespace here never
+     * includes '\n', so line counting is unaffected. */
+    const __m128i sp  = _mm_set1_epi8(' ');
+    const __m128i tab = _mm_set1_epi8('\t');
+    const __m128i cr  = _mm_set1_epi8('\r');
+    while (lex->pos + 16 <= lex->length) {
+        __m128i v = _mm_loadu_si128((const __m128i*)(lex->input + lex->pos));
+        __m128i ws = _mm_or_si128(_mm_or_si128(_mm_cmpeq_epi8(v, sp),
+                                               _mm_cmpeq_epi8(v, tab)),
+                                  _mm_cmpeq_epi8(v, cr));
+        unsigned int mask = (unsigned int)_mm_movemask_epi8(ws);
+        if (mask != 0xFFFFu) {
+            lex->pos += (size_t)__builtin_ctz(~mask);
+            return;
+        }
+        lex->pos += 16;
+    }
+#endif
+    /* One class-table load per byte instead of three compares; '\0' at end
+     * of input classifies as LC_OTHER and terminates the loop */
+    while (lex_class[(unsigned char)lexer_peek(lex)] == LC_SPACE) {
         lexer_advance(lex);
     }
 }
 
 static int lexer_read_multiline(Lexer* lex, Token* tok) {
-    /* Already consumed #%%% */
-    char* dest = tok->text;
-    size_t max_len = MAX_STRING_VALUE - 1;
-    size_t written = 0;
-    
-    while (lex->pos < lex->length && written < max_len) {
-        /* Check for end marker %%%# */
-        if (lex->pos + 3 < lex->length &&
-            lex->input[lex->pos] == '%' &&
-            lex->input[lex->pos + 1] == '%' &&
-            lex->input[lex->pos + 2] == '%' &&
-            lex->input[lex->pos + 3] == '#') {
-            /* Found end marker */
-            lex->pos += 4;
-            dest[written] = '\0';
-            tok->type = TOK_STRING;
-            return 1;
+    /* Already consumed #%%% - locate the %%%# end marker directly in the
+     * input instead of checking four bytes at every position */
+    const char* start = lex->input + lex->pos;
+    size_t remaining = lex->length - lex->pos;
+    const char* marker = NULL;
+
+    const char* scan = start;
+    size_t left = remaining;
+
+#ifdef CFG_USE_SSE2
+    /* Compare 16 bytes at a time against '%'; candidate positions come out
+     * of the movemask and only those get the 4-byte tail check. Typical
+     * multiline payloads contain no '%' at all, so this is one compare
+     * per 16 bytes instead of one memchr call per stray '%'. */
+    {
+        const __m128i pct16 = _mm_set1_epi8('%');
+        while (left >= 16 + 3 && !marker) {
+            __m128i v = _mm_loadu_si128((const __m128i*)scan);
+            unsigned int mask =
+                (unsigned int)_mm_movemask_epi8(_mm_cmpeq_epi8(v, pct16));
+            while (mask) {
+                unsigned int at = (unsigned int)__builtin_ctz(mask);
+                const char* cand = scan + at;
+                if (cand[1] == '%' && cand[2] == '%' && cand[3] == '#') {
+                    marker = cand;
+                    break;
+                }
+                mask &= mask - 1;
+            }
+            if (!marker) {
+                scan += 16;
+                left -= 16;
+            }
         }
-        
-        char c = lexer_advance(lex);
-        dest[written++] = c;
     }
-    
-    /* Missing end marker */
-    tok->type = TOK_ERROR;
-    return 0;
+#endif
+
+    /* Scalar tail (and full scan when SSE2 is unavailable): memchr between
+     * '%' occurrences, which libc vectorizes */
+    while (!marker && left >= 4) {
+        const char* pct = memchr(scan, '%', left - 3);
+        if (!pct) break;
+        if (pct[1] == '%' && pct[2] == '%' && pct[3] == '#') {
+            marker = pct;
+            break;
+        }
+        left -= (size_t)(pct - scan) + 1;
+        scan = pct + 1;
+    }
+
+    /* Missing end marker, or payload too large to store */
+    if (!marker || (size_t)(marker - start) > MAX_STRING_VALUE - 1) {
+        tok->type = TOK_ERROR;
+        return 0;
+    }
+
+    size_t n = (size_t)(marker - start);
+    tok->start = start;
+    tok->len = (uint32_t)n;
+    tok->type = TOK_STRING;
+
+    lex->pos += n + 4;
+    return 1;
+}
+
+/* Keyword classification: the three reserved words all have distinct
+ * lengths, so the length is a perfect discriminator and each candidate
+ * needs one short memcmp (lowered to a word compare) - the hand-coded
+ * equivalent of a gperf perfect hash for a 3-entry keyword set */
+static CFG_ALWAYS_INLINE uint8_t keyword_or_ident(const char* start, size_t len) {
+    switch (len) {
+        case 2:
+            if (memcmp(start, "if", 2) == 0) return TOK_IF;
+            break;
+        case 3:
+            if (memcmp(start, "set", 3) == 0) return TOK_SET;
+            break;
+        case 5:
+            if (memcmp(start, "const", 5) == 0) return TOK_CONST;
+            break;
+        default:
+            break;
+    }
+    return TOK_IDENT;
 }
 
-static Token lexer_next_token(Lexer* lex) {
+static CFG_HOT Token lexer_next_token(Lexer* restrict lex) {
     Token tok;
     memset(&tok, 0, sizeof(Token));
-    
+
+    /* Loop instead of tail-calling ourselves after a comment: the recursion
+     * is not guaranteed to be optimized away with a struct return */
+    for (;;) {
+
     lexer_skip_whitespace(lex);
-    
+
     char c = lexer_peek(lex);
-    
+
     /* End of input */
     if (c == '\0') {
         tok.type = TOK_EOF;
         return tok;
     }
-    
-    /* Newline */
-    if (c == '\n') {
+
+    /* One table-driven dispatch on the character class instead of a chain
+     * of per-character compares */
+    switch (lex_class[(unsigned char)c]) {
+
+    case LC_NEWLINE:
         lexer_advance(lex);
         tok.type = TOK_NEWLINE;
         return tok;
-    }
-    
-    /* Comment */
-    if (c == '#') {
+
+    case LC_HASH:
         /* Check for multiline marker #%%% */
         if (lex->pos + 3 < lex->length &&
             lex->input[lex->pos + 1] == '%' &&
@@ -211,54 +521,66 @@ static Token lexer_next_token(Lexer* lex) {
             lexer_read_multiline(lex, &tok);
             return tok;
         }
-        
-        /* Regular comment - skip to end of line */
-        while (lexer_peek(lex) != '\n' && lexer_peek(lex) != '\0') {
-            lexer_advance(lex);
+
+        /* Regular comment - jump straight to the end of the line (memchr is
+         * vectorized by libc, so long comments cost one scan, not one branch
+         * per byte) */
+        {
+            const char* nl = memchr(lex->input + lex->pos, '\n',
+                                    lex->length - lex->pos);
+            lex->pos = nl ? (size_t)(nl - lex->input) : lex->length;
         }
-        return lexer_next_token(lex);
-    }
-    
-    /* String literal */
-    if (c == '"') {
+        continue;
+
+    case LC_QUOTE: {
         lexer_advance(lex);
-        size_t i = 0;
+        size_t start_pos = lex->pos;
         while (lexer_peek(lex) != '"' && lexer_peek(lex) != '\0' && lexer_peek(lex) != '\n') {
-            if (i < MAX_STRING_VALUE - 1) {
-                tok.text[i++] = lexer_advance(lex);
-            } else {
-                lexer_advance(lex);
-            }
+            lexer_advance(lex);
         }
+        tok.start = lex->input + start_pos;
+        tok.len = (uint32_t)(lex->pos - start_pos);
         if (lexer_peek(lex) == '"') {
             lexer_advance(lex);
         }
-        tok.text[i] = '\0';
         tok.type = TOK_STRING;
         return tok;
     }
-    
-    /* Number */
-    if (isdigit(c) || (c == '-' && isdigit(lex->input[lex->pos + 1]))) {
-        size_t i = 0;
+
+    case LC_MINUS:
+        if (lex->pos + 1 >= lex->length || !LEX_IS_DIGIT(lex->input[lex->pos + 1])) {
+            tok.type = TOK_ERROR;
+            return tok;
+        }
+        /* fall through */
+    case LC_DIGIT: {
+        tok.start = lex->input + lex->pos;
+        int neg = 0;
         if (c == '-') {
-            tok.text[i++] = lexer_advance(lex);
+            neg = 1;
+            lexer_advance(lex);
         }
-        while (isdigit(lexer_peek(lex))) {
-            if (i < MAX_STRING_VALUE - 1) {
-                tok.text[i++] = lexer_advance(lex);
-            } else {
-                lexer_advance(lex);
+        /* Accumulate in place - atoi would need a NUL-terminated copy.
+         * Values that would overflow saturate at INT_MAX. */
+        int val = 0;
+        while (LEX_IS_DIGIT(lexer_peek(lex))) {
+            int d = lexer_advance(lex) - '0';
+            if (val > (INT_MAX - d) / 10) {
+                val = INT_MAX;
+                while (LEX_IS_DIGIT(lexer_peek(lex))) {
+                    lexer_advance(lex);
+                }
+                break;
             }
+            val = val * 10 + d;
         }
-        tok.text[i] = '\0';
-        tok.int_value = atoi(tok.text);
+        tok.len = (uint32_t)((lex->input + lex->pos) - tok.start);
+        tok.int_value = neg ? -val : val;
         tok.type = TOK_NUMBER;
         return tok;
     }
-    
-    /* Operators */
-    if (c == '=') {
+
+    case LC_ASSIGN:
         lexer_advance(lex);
         if (lexer_peek(lex) == '=') {
             lexer_advance(lex);
@@ -267,9 +589,8 @@ static Token lexer_next_token(Lexer* lex) {
             tok.type = TOK_ASSIGN;
         }
         return tok;
-    }
-    
-    if (c == '>') {
+
+    case LC_GT:
         lexer_advance(lex);
         if (lexer_peek(lex) == '=') {
             lexer_advance(lex);
@@ -278,9 +599,8 @@ static Token lexer_next_token(Lexer* lex) {
             tok.type = TOK_GT;
         }
         return tok;
-    }
-    
-    if (c == '<') {
+
+    case LC_LT:
         lexer_advance(lex);
         if (lexer_peek(lex) == '=') {
             lexer_advance(lex);
@@ -289,9 +609,8 @@ static Token lexer_next_token(Lexer* lex) {
             tok.type = TOK_LT;
         }
         return tok;
-    }
-    
-    if (c == '!') {
+
+    case LC_BANG:
         lexer_advance(lex);
         if (lexer_peek(lex) == '=') {
             lexer_advance(lex);
@@ -300,331 +619,893 @@ static Token lexer_next_token(Lexer* lex) {
             tok.type = TOK_ERROR;
         }
         return tok;
-    }
-    
-    if (c == '{') {
+
+    case LC_LBRACE:
         lexer_advance(lex);
         tok.type = TOK_LBRACE;
         return tok;
-    }
-    
-    if (c == '}') {
+
+    case LC_RBRACE:
         lexer_advance(lex);
         tok.type = TOK_RBRACE;
         return tok;
-    }
-    
-    /* Identifier or keyword */
-    if (isalpha(c) || c == '_') {
+
+    case LC_IDENT: {
+        /* Identifier or keyword - fold each byte into the FNV-1a hash as it
+         * is read so later lookups never re-hash the name */
+        tok.start = lex->input + lex->pos;
         size_t i = 0;
-        while ((isalnum(lexer_peek(lex)) || lexer_peek(lex) == '_') && i < MAX_VAR_NAME - 1) {
-            tok.text[i++] = lexer_advance(lex);
-        }
-        tok.text[i] = '\0';
-        
-        /* Check for keywords */
-        if (strcmp(tok.text, "set") == 0) {
-            tok.type = TOK_SET;
-        } else if (strcmp(tok.text, "const") == 0) {
-            tok.type = TOK_CONST;
-        } else if (strcmp(tok.text, "if") == 0) {
-            tok.type = TOK_IF;
-        } else {
-            tok.type = TOK_IDENT;
+        uint32_t h = 2166136261u;
+        while (LEX_IS_IDENT_CONT(lexer_peek(lex)) && i < MAX_VAR_NAME - 1) {
+            h = (h ^ (unsigned char)lexer_advance(lex)) * 0x01000193u;
+            i++;
         }
+        tok.len = (uint32_t)i;
+        tok.hash = h;
+        tok.type = keyword_or_ident(tok.start, i);
         return tok;
     }
-    
-    /* Unknown character */
-    tok.type = TOK_ERROR;
-    return tok;
+
+    default:
+        /* Unknown character */
+        tok.type = TOK_ERROR;
+        return tok;
+    }
+
+    } /* for (;;) */
 }
 
 /* ========================================================================
- * PARSER / INTERPRETER
+ * COMPILER
+ *
+ * Source is compiled once into a flat instruction stream (CfgProgram) and
+ * executed separately. Compiled programs are cached per instance keyed by a
+ * content hash of the source, so loading the same bytes again skips lexing
+ * and parsing entirely and only re-runs the executor. Runtime effects
+ * (variable creation, const checks, condition values) happen at execution
+ * time, in the same order the old direct interpreter applied them.
  * ======================================================================== */
 
+/* Reference to a name or string payload in a program's string pool */
+typedef struct {
+    uint32_t off;
+    uint32_t len;
+    uint32_t hash;   /* FNV-1a of the bytes, used for variable names */
+} StrRef;
+
+enum {
+    OP_SET_INT,   /* name = integer literal */
+    OP_SET_STR,   /* name = string payload from the pool */
+    OP_SET_COPY,  /* name = value of another variable */
+    OP_JMP_FALSE, /* jump to target when the condition is false */
+    OP_JMP        /* unconditional jump (skips an else block) */
+};
+
+typedef struct {
+    uint8_t op;
+    uint8_t is_const;    /* OP_SET_*: statement came from 'const set' */
+    uint8_t cmp_mask;    /* OP_JMP_FALSE: CMP_* bits satisfying the operator */
+    uint8_t lhs_is_var;  /* OP_JMP_FALSE operand kinds */
+    uint8_t rhs_is_var;
+    uint32_t src_pos;    /* source offset, for lazy error line numbers */
+    StrRef name;         /* OP_SET_*: target variable */
+    union {
+        int int_val;     /* OP_SET_INT */
+        StrRef str;      /* OP_SET_STR */
+        StrRef src;      /* OP_SET_COPY */
+        struct {
+            int lhs_int, rhs_int;  /* literal operands */
+            StrRef lhs, rhs;       /* variable operands */
+            int target;
+        } jmp;           /* OP_JMP_FALSE / OP_JMP */
+    } u;
+} Instr;
+
+struct CfgProgram {
+    uint64_t src_hash;
+    size_t src_len;
+    char* src;           /* source copy: exact cache match + error lines */
+    Instr* code;
+    int count;
+    int cap;
+    char* pool;          /* names and string payloads, each NUL-terminated */
+    size_t pool_len;
+    size_t pool_cap;
+    uint32_t stamp;      /* LRU age, bumped on every use */
+    uint8_t pool_borrowed; /* a variable holds a view into the pool */
+};
+
+static void free_program(CfgProgram* prog) {
+    if (!prog) return;
+    free(prog->src);
+    free(prog->code);
+    free(prog->pool);
+    free(prog);
+}
+
+/* FNV-1a (64-bit) over a source buffer - the program cache key */
+static uint64_t hash_source(const char* s, size_t len) {
+    uint64_t h = 1469598103934665603ULL;
+    for (size_t i = 0; i < len; i++) {
+        h = (h ^ (unsigned char)s[i]) * 1099511628211ULL;
+    }
+    return h;
+}
+
+/* Line number of a source offset, computed only when an error is reported */
+static int prog_line(const CfgProgram* prog, uint32_t pos) {
+    int line = 1;
+    const char* p = prog->src;
+    const char* end = prog->src + ((size_t)pos < prog->src_len ? pos : prog->src_len);
+    while (p < end && (p = memchr(p, '\n', (size_t)(end - p))) != NULL) {
+        line++;
+        p++;
+    }
+    return line;
+}
+
+/* Append an instruction; returns its index or -1 on allocation failure */
+static int emit(CfgProgram* prog, const Instr* ins) {
+    if (prog->count == prog->cap) {
+        int grown = prog->cap ? prog->cap * 2 : 16;
+        Instr* code = (Instr*)realloc(prog->code, (size_t)grown * sizeof(Instr));
+        if (!code) return -1;
+        prog->code = code;
+        prog->cap = grown;
+    }
+    prog->code[prog->count] = *ins;
+    return prog->count++;
+}
+
+/* Copy bytes into the string pool (NUL-terminated); returns the offset or
+ * fills ref and returns ERR_CFG_OK/-ENOMEM style status */
+static int pool_add(CfgProgram* prog, const char* s, size_t len, uint32_t hash,
+                    StrRef* ref) {
+    if (prog->pool_len + len + 1 > prog->pool_cap) {
+        size_t grown_cap = prog->pool_cap ? prog->pool_cap * 2 : 64;
+        while (grown_cap < prog->pool_len + len + 1) {
+            grown_cap *= 2;
+        }
+        char* grown = (char*)realloc(prog->pool, grown_cap);
+        if (!grown) return ERR_CFG_OUT_OF_MEMORY;
+        prog->pool = grown;
+        prog->pool_cap = grown_cap;
+    }
+    ref->off = (uint32_t)prog->pool_len;
+    ref->len = (uint32_t)len;
+    ref->hash = hash;
+    memcpy(prog->pool + prog->pool_len, s, len);
+    prog->pool[prog->pool_len + len] = '\0';
+    prog->pool_len += len + 1;
+    return ERR_CFG_OK;
+}
+
 typedef struct {
     Lexer* lexer;
     Token current;
     Token peek;
     ConfigLang* cfg;
+    CfgProgram* prog;
 } Parser;
 
+/* Token is a small slice handle, so shifting the lookahead is a move of a
+ * few words rather than the 1 KB struct copy it used to be */
 static void parser_advance(Parser* p) {
     p->current = p->peek;
     p->peek = lexer_next_token(p->lexer);
 }
 
-static void parser_init(Parser* p, Lexer* lex, ConfigLang* cfg) {
+static void parser_init(Parser* p, Lexer* lex, ConfigLang* cfg, CfgProgram* prog) {
     p->lexer = lex;
     p->cfg = cfg;
+    p->prog = prog;
+    p->current = lexer_next_token(lex);
     p->peek = lexer_next_token(lex);
-    parser_advance(p);
 }
 
-static int eval_condition(Parser* p, int* result);
-static int parse_statement(Parser* p);
+static int compile_statement(Parser* p);
 
-/* Parse expression (for assignment values) */
-static int parse_value(Parser* p, Variable* var) {
+/* Compile the value side of an assignment into a prepared OP_SET_* instr */
+static int compile_value(Parser* p, Instr* ins) {
     if (p->current.type == TOK_NUMBER) {
-        var->type = VAR_TYPE_INT;
-        var->value.int_val = p->current.int_value;
+        ins->op = OP_SET_INT;
+        ins->u.int_val = p->current.int_value;
         parser_advance(p);
         return ERR_CFG_OK;
     } else if (p->current.type == TOK_STRING) {
-        var->type = VAR_TYPE_STRING;
-        strncpy(var->value.str_val, p->current.text, MAX_STRING_VALUE - 1);
-        var->value.str_val[MAX_STRING_VALUE - 1] = '\0';
+        ins->op = OP_SET_STR;
+        if (pool_add(p->prog, p->current.start, p->current.len, 0,
+                     &ins->u.str) != ERR_CFG_OK) {
+            set_error(p->cfg, ERR_CFG_OUT_OF_MEMORY, "Out of memory", lexer_line(p->lexer));
+            return ERR_CFG_OUT_OF_MEMORY;
+        }
         parser_advance(p);
         return ERR_CFG_OK;
     } else if (p->current.type == TOK_IDENT) {
-        /* Reference to another variable */
-        Variable* src = find_variable(p->cfg, p->current.text);
-        if (!src) {
-            set_error(p->cfg, ERR_CFG_VARIABLE_NOT_FOUND, "Variable not found", p->lexer->line_number);
-            return ERR_CFG_VARIABLE_NOT_FOUND;
-        }
-        var->type = src->type;
-        if (src->type == VAR_TYPE_INT) {
-            var->value.int_val = src->value.int_val;
-        } else {
-            strncpy(var->value.str_val, src->value.str_val, MAX_STRING_VALUE - 1);
-            var->value.str_val[MAX_STRING_VALUE - 1] = '\0';
+        /* Reference to another variable, resolved at execution time */
+        ins->op = OP_SET_COPY;
+        if (pool_add(p->prog, p->current.start, p->current.len,
+                     p->current.hash, &ins->u.src) != ERR_CFG_OK) {
+            set_error(p->cfg, ERR_CFG_OUT_OF_MEMORY, "Out of memory", lexer_line(p->lexer));
+            return ERR_CFG_OUT_OF_MEMORY;
         }
         parser_advance(p);
         return ERR_CFG_OK;
     }
-    
-    set_error(p->cfg, ERR_CFG_PARSE_ERROR, "Expected value", p->lexer->line_number);
+
+    set_error(p->cfg, ERR_CFG_PARSE_ERROR, "Expected value", lexer_line(p->lexer));
     return ERR_CFG_PARSE_ERROR;
 }
 
-/* Parse set statement: set name = value */
-static int parse_set(Parser* p, int is_const) {
+/* Compile a set statement: set name = value */
+static int compile_set(Parser* p, int is_const) {
+    Instr ins;
+    memset(&ins, 0, sizeof(ins));
+    ins.is_const = (uint8_t)is_const;
+    ins.src_pos = (uint32_t)p->lexer->pos;
+
     parser_advance(p); /* consume 'set' */
-    
+
     if (p->current.type != TOK_IDENT) {
-        set_error(p->cfg, ERR_CFG_PARSE_ERROR, "Expected variable name", p->lexer->line_number);
+        set_error(p->cfg, ERR_CFG_PARSE_ERROR, "Expected variable name", lexer_line(p->lexer));
         return ERR_CFG_PARSE_ERROR;
     }
-    
-    char var_name[MAX_VAR_NAME];
-    strncpy(var_name, p->current.text, MAX_VAR_NAME - 1);
-    var_name[MAX_VAR_NAME - 1] = '\0';
-    
+
+    uint32_t var_len = p->current.len;
+    if (var_len > MAX_VAR_NAME - 1) {
+        var_len = MAX_VAR_NAME - 1;
+    }
+    if (pool_add(p->prog, p->current.start, var_len, p->current.hash,
+                 &ins.name) != ERR_CFG_OK) {
+        set_error(p->cfg, ERR_CFG_OUT_OF_MEMORY, "Out of memory", lexer_line(p->lexer));
+        return ERR_CFG_OUT_OF_MEMORY;
+    }
+
     parser_advance(p);
-    
+
     if (p->current.type != TOK_ASSIGN) {
-        set_error(p->cfg, ERR_CFG_PARSE_ERROR, "Expected '='", p->lexer->line_number);
+        set_error(p->cfg, ERR_CFG_PARSE_ERROR, "Expected '='", lexer_line(p->lexer));
         return ERR_CFG_PARSE_ERROR;
     }
-    
+
     parser_advance(p);
-    
-    /* Check if variable exists */
-    Variable* var = find_variable(p->cfg, var_name);
-    if (var) {
-        /* Variable exists - check if const */
-        if (var->is_const) {
-            set_error(p->cfg, ERR_CFG_CONST_VIOLATION, "Cannot modify const variable", p->lexer->line_number);
-            return ERR_CFG_CONST_VIOLATION;
-        }
-    } else {
-        /* Create new variable */
-        var = create_variable(p->cfg, var_name);
-        if (!var) {
-            set_error(p->cfg, ERR_CFG_OUT_OF_MEMORY, "Too many variables", p->lexer->line_number);
-            return ERR_CFG_OUT_OF_MEMORY;
-        }
-        var->is_const = is_const;
+
+    int err = compile_value(p, &ins);
+    if (err != ERR_CFG_OK) {
+        return err;
     }
-    
-    return parse_value(p, var);
+    if (emit(p->prog, &ins) < 0) {
+        set_error(p->cfg, ERR_CFG_OUT_OF_MEMORY, "Out of memory", lexer_line(p->lexer));
+        return ERR_CFG_OUT_OF_MEMORY;
+    }
+    return ERR_CFG_OK;
 }
 
-/* Evaluate condition and return result */
-static int eval_condition(Parser* p, int* result) {
-    /* Get left side */
-    if (p->current.type != TOK_IDENT && p->current.type != TOK_NUMBER) {
-        set_error(p->cfg, ERR_CFG_PARSE_ERROR, "Expected identifier or number", p->lexer->line_number);
-        return ERR_CFG_PARSE_ERROR;
-    }
-    
-    int left_val;
+/* Relation bits for the branch-free comparison dispatch in the executor;
+ * the mask table is indexed by operator, so TOK_GT..TOK_NEQ must stay
+ * contiguous */
+enum { CMP_LT = 1, CMP_EQ = 2, CMP_GT = 4 };
+
+/* Compile one side of a condition into a prepared OP_JMP_FALSE instr */
+static int compile_cond_operand(Parser* p, Instr* ins, int is_rhs) {
     if (p->current.type == TOK_NUMBER) {
-        left_val = p->current.int_value;
-    } else {
-        Variable* var = find_variable(p->cfg, p->current.text);
-        if (!var) {
-            set_error(p->cfg, ERR_CFG_VARIABLE_NOT_FOUND, "Variable not found in condition", p->lexer->line_number);
-            return ERR_CFG_VARIABLE_NOT_FOUND;
-        }
-        if (var->type != VAR_TYPE_INT) {
-            set_error(p->cfg, ERR_CFG_TYPE_MISMATCH, "Condition requires integer", p->lexer->line_number);
-            return ERR_CFG_TYPE_MISMATCH;
+        if (is_rhs) {
+            ins->u.jmp.rhs_int = p->current.int_value;
+        } else {
+            ins->u.jmp.lhs_int = p->current.int_value;
         }
-        left_val = var->value.int_val;
-    }
-    
-    parser_advance(p);
-    
-    /* Get operator */
-    TokenType op = p->current.type;
-    if (op != TOK_GT && op != TOK_LT && op != TOK_GTE && op != TOK_LTE && op != TOK_EQ && op != TOK_NEQ) {
-        set_error(p->cfg, ERR_CFG_PARSE_ERROR, "Expected comparison operator", p->lexer->line_number);
-        return ERR_CFG_PARSE_ERROR;
-    }
-    
-    parser_advance(p);
-    
-    /* Get right side */
-    if (p->current.type != TOK_IDENT && p->current.type != TOK_NUMBER) {
-        set_error(p->cfg, ERR_CFG_PARSE_ERROR, "Expected identifier or number", p->lexer->line_number);
-        return ERR_CFG_PARSE_ERROR;
+        parser_advance(p);
+        return ERR_CFG_OK;
     }
-    
-    int right_val;
-    if (p->current.type == TOK_NUMBER) {
-        right_val = p->current.int_value;
-    } else {
-        Variable* var = find_variable(p->cfg, p->current.text);
-        if (!var) {
-            set_error(p->cfg, ERR_CFG_VARIABLE_NOT_FOUND, "Variable not found in condition", p->lexer->line_number);
-            return ERR_CFG_VARIABLE_NOT_FOUND;
+    if (p->current.type == TOK_IDENT) {
+        StrRef* ref = is_rhs ? &ins->u.jmp.rhs : &ins->u.jmp.lhs;
+        if (pool_add(p->prog, p->current.start, p->current.len,
+                     p->current.hash, ref) != ERR_CFG_OK) {
+            set_error(p->cfg, ERR_CFG_OUT_OF_MEMORY, "Out of memory", lexer_line(p->lexer));
+            return ERR_CFG_OUT_OF_MEMORY;
         }
-        if (var->type != VAR_TYPE_INT) {
-            set_error(p->cfg, ERR_CFG_TYPE_MISMATCH, "Condition requires integer", p->lexer->line_number);
-            return ERR_CFG_TYPE_MISMATCH;
+        if (is_rhs) {
+            ins->rhs_is_var = 1;
+        } else {
+            ins->lhs_is_var = 1;
         }
-        right_val = var->value.int_val;
-    }
-    
-    parser_advance(p);
-    
-    /* Evaluate */
-    switch (op) {
-        case TOK_GT:  *result = (left_val > right_val); break;
-        case TOK_LT:  *result = (left_val < right_val); break;
-        case TOK_GTE: *result = (left_val >= right_val); break;
-        case TOK_LTE: *result = (left_val <= right_val); break;
-        case TOK_EQ:  *result = (left_val == right_val); break;
-        case TOK_NEQ: *result = (left_val != right_val); break;
-        default: *result = 0;
+        parser_advance(p);
+        return ERR_CFG_OK;
     }
-    
-    return ERR_CFG_OK;
+
+    set_error(p->cfg, ERR_CFG_PARSE_ERROR, "Expected identifier or number", lexer_line(p->lexer));
+    return ERR_CFG_PARSE_ERROR;
 }
 
-/* Parse if statement */
-static int parse_if(Parser* p) {
+/* Compile an if statement (and any chained ifs after its closing brace) */
+static int compile_if(Parser* p) {
+    Instr ins;
+    memset(&ins, 0, sizeof(ins));
+    ins.op = OP_JMP_FALSE;
+    ins.src_pos = (uint32_t)p->lexer->pos;
+
     parser_advance(p); /* consume 'if' */
-    
-    int condition;
-    int err = eval_condition(p, &condition);
+
+    int err = compile_cond_operand(p, &ins, 0);
     if (err != ERR_CFG_OK) return err;
-    
+
+    uint8_t op = p->current.type;
+    if (op != TOK_GT && op != TOK_LT && op != TOK_GTE && op != TOK_LTE && op != TOK_EQ && op != TOK_NEQ) {
+        set_error(p->cfg, ERR_CFG_PARSE_ERROR, "Expected comparison operator", lexer_line(p->lexer));
+        return ERR_CFG_PARSE_ERROR;
+    }
+    /* Resolve the operator to its relation mask here, so execution never
+     * looks at the operator again - just one AND against the mask */
+    static const uint8_t cmp_mask[6] = {
+        CMP_GT,          /* TOK_GT  */
+        CMP_LT,          /* TOK_LT  */
+        CMP_GT | CMP_EQ, /* TOK_GTE */
+        CMP_LT | CMP_EQ, /* TOK_LTE */
+        CMP_EQ,          /* TOK_EQ  */
+        CMP_LT | CMP_GT  /* TOK_NEQ */
+    };
+    ins.cmp_mask = cmp_mask[op - TOK_GT];
+    parser_advance(p);
+
+    err = compile_cond_operand(p, &ins, 1);
+    if (err != ERR_CFG_OK) return err;
+
+    int jmp_false = emit(p->prog, &ins);
+    if (jmp_false < 0) {
+        set_error(p->cfg, ERR_CFG_OUT_OF_MEMORY, "Out of memory", lexer_line(p->lexer));
+        return ERR_CFG_OUT_OF_MEMORY;
+    }
+
     /* Expect { */
     if (p->current.type != TOK_LBRACE) {
-        set_error(p->cfg, ERR_CFG_PARSE_ERROR, "Expected '{'", p->lexer->line_number);
+        set_error(p->cfg, ERR_CFG_PARSE_ERROR, "Expected '{'", lexer_line(p->lexer));
         return ERR_CFG_PARSE_ERROR;
     }
     parser_advance(p);
-    
-    /* Parse then block */
-    if (condition) {
-        err = parse_statement(p);
-        if (err != ERR_CFG_OK) return err;
-    } else {
-        /* Skip then block */
-        while (p->current.type != TOK_RBRACE && p->current.type != TOK_EOF) {
-            parser_advance(p);
-        }
-    }
-    
+
+    /* Then block */
+    err = compile_statement(p);
+    if (err != ERR_CFG_OK) return err;
+
     /* Expect } */
     if (p->current.type != TOK_RBRACE) {
-        set_error(p->cfg, ERR_CFG_PARSE_ERROR, "Expected '}'", p->lexer->line_number);
+        set_error(p->cfg, ERR_CFG_PARSE_ERROR, "Expected '}'", lexer_line(p->lexer));
         return ERR_CFG_PARSE_ERROR;
     }
     parser_advance(p);
-    
-    /* Check for else block or nested if */
+
+    /* Check for else block or chained if */
     if (p->current.type == TOK_IF) {
-        /* Nested if - this is a chained condition */
-        return parse_if(p);
+        /* Chained if runs regardless of this condition: both paths meet
+         * here, so the false-jump lands on the chained if itself */
+        p->prog->code[jmp_false].u.jmp.target = p->prog->count;
+        return compile_if(p);
     } else if (p->current.type == TOK_LBRACE) {
-        /* Else block */
-        parser_advance(p);
-        
-        if (!condition) {
-            err = parse_statement(p);
-            if (err != ERR_CFG_OK) return err;
-        } else {
-            /* Skip else block */
-            while (p->current.type != TOK_RBRACE && p->current.type != TOK_EOF) {
-                parser_advance(p);
-            }
+        /* Else block: the then path jumps over it */
+        Instr skip;
+        memset(&skip, 0, sizeof(skip));
+        skip.op = OP_JMP;
+        int jmp_end = emit(p->prog, &skip);
+        if (jmp_end < 0) {
+            set_error(p->cfg, ERR_CFG_OUT_OF_MEMORY, "Out of memory", lexer_line(p->lexer));
+            return ERR_CFG_OUT_OF_MEMORY;
         }
-        
+        p->prog->code[jmp_false].u.jmp.target = p->prog->count;
+
+        parser_advance(p);
+
+        err = compile_statement(p);
+        if (err != ERR_CFG_OK) return err;
+
         if (p->current.type != TOK_RBRACE) {
-            set_error(p->cfg, ERR_CFG_PARSE_ERROR, "Expected '}'", p->lexer->line_number);
+            set_error(p->cfg, ERR_CFG_PARSE_ERROR, "Expected '}'", lexer_line(p->lexer));
             return ERR_CFG_PARSE_ERROR;
         }
         parser_advance(p);
+        p->prog->code[jmp_end].u.jmp.target = p->prog->count;
+    } else {
+        p->prog->code[jmp_false].u.jmp.target = p->prog->count;
     }
-    
+
     return ERR_CFG_OK;
 }
 
-/* Parse single statement */
-static int parse_statement(Parser* p) {
+/* Compile a single statement */
+static int compile_statement(Parser* p) {
     /* Skip empty lines */
     while (p->current.type == TOK_NEWLINE) {
         parser_advance(p);
     }
-    
+
     if (p->current.type == TOK_EOF) {
         return ERR_CFG_OK;
     }
-    
+
     if (p->current.type == TOK_CONST) {
         parser_advance(p);
         if (p->current.type != TOK_SET) {
-            set_error(p->cfg, ERR_CFG_PARSE_ERROR, "Expected 'set' after 'const'", p->lexer->line_number);
+            set_error(p->cfg, ERR_CFG_PARSE_ERROR, "Expected 'set' after 'const'", lexer_line(p->lexer));
             return ERR_CFG_PARSE_ERROR;
         }
-        return parse_set(p, 1);
+        return compile_set(p, 1);
     }
-    
+
     if (p->current.type == TOK_SET) {
-        return parse_set(p, 0);
+        return compile_set(p, 0);
     }
-    
+
     if (p->current.type == TOK_IF) {
-        return parse_if(p);
+        return compile_if(p);
     }
-    
-    set_error(p->cfg, ERR_CFG_PARSE_ERROR, "Unexpected token", p->lexer->line_number);
+
+    set_error(p->cfg, ERR_CFG_PARSE_ERROR, "Unexpected token", lexer_line(p->lexer));
     return ERR_CFG_PARSE_ERROR;
 }
 
-/* Parse entire program */
-static int parse_program(Parser* p) {
-    while (p->current.type != TOK_EOF) {
-        int err = parse_statement(p);
-        if (err != ERR_CFG_OK) {
-            return err;
+static void optimize_program(CfgProgram* prog, unsigned flags);
+
+/* Compile an entire source buffer; returns NULL with *err_out/last_error
+ * set on failure */
+static CfgProgram* compile_source(ConfigLang* cfg, const char* buf, size_t length,
+                                  uint64_t src_hash, int* err_out) {
+    CfgProgram* prog = (CfgProgram*)calloc(1, sizeof(CfgProgram));
+    if (!prog) {
+        set_error(cfg, ERR_CFG_OUT_OF_MEMORY, "Out of memory", 0);
+        *err_out = ERR_CFG_OUT_OF_MEMORY;
+        return NULL;
+    }
+    prog->src = (char*)malloc(length + 1);
+    if (!prog->src) {
+        free_program(prog);
+        set_error(cfg, ERR_CFG_OUT_OF_MEMORY, "Out of memory", 0);
+        *err_out = ERR_CFG_OUT_OF_MEMORY;
+        return NULL;
+    }
+    memcpy(prog->src, buf, length);
+    prog->src[length] = '\0';
+    prog->src_len = length;
+    prog->src_hash = src_hash;
+
+    /* Size the instruction and pool arrays from the source up front - a
+     * statement is rarely shorter than 16 bytes and the pool never holds
+     * more than the source's names and payloads plus their terminators,
+     * so typical compiles never touch realloc after this */
+    int est_code = (int)(length / 16) + 8;
+    size_t est_pool = length / 2 + 64;
+    prog->code = (Instr*)malloc((size_t)est_code * sizeof(Instr));
+    prog->pool = (char*)malloc(est_pool);
+    if (!prog->code || !prog->pool) {
+        free_program(prog);
+        set_error(cfg, ERR_CFG_OUT_OF_MEMORY, "Out of memory", 0);
+        *err_out = ERR_CFG_OUT_OF_MEMORY;
+        return NULL;
+    }
+    prog->cap = est_code;
+    prog->pool_cap = est_pool;
+
+    Lexer lex;
+    lexer_init(&lex, prog->src, length);
+
+    Parser parser;
+    parser_init(&parser, &lex, cfg, prog);
+
+    while (parser.current.type != TOK_EOF) {
+        int err = compile_statement(&parser);
+        if (CFG_UNLIKELY(err != ERR_CFG_OK)) {
+            free_program(prog);
+            *err_out = err;
+            return NULL;
         }
-        
+
         /* Consume newlines */
-        while (p->current.type == TOK_NEWLINE) {
-            parser_advance(p);
+        while (parser.current.type == TOK_NEWLINE) {
+            parser_advance(&parser);
+        }
+    }
+
+    if (cfg->opt_flags != CFG_OPT_NONE) {
+        optimize_program(prog, cfg->opt_flags);
+    }
+
+    *err_out = ERR_CFG_OK;
+    return prog;
+}
+
+/* ========================================================================
+ * OPTIMIZER
+ *
+ * Optional passes over a freshly compiled instruction stream, selected per
+ * instance with cfg_set_optimization and all off by default. Folding only
+ * uses facts the program itself establishes (an OP_SET_INT earlier on every
+ * path to the condition), so a cached program stays correct no matter what
+ * variable state it later runs against. The passes are best-effort: if a
+ * scratch allocation fails the program simply runs unoptimized.
+ * ======================================================================== */
+
+/* Last-known integer assignment per variable name during folding */
+typedef struct {
+    StrRef name;
+    int val;
+    uint8_t known;
+} FoldEntry;
+
+static FoldEntry* fold_find(FoldEntry* tab, int count, const char* pool,
+                            const StrRef* name) {
+    for (int i = 0; i < count; i++) {
+        if (tab[i].name.hash == name->hash && tab[i].name.len == name->len &&
+            memcmp(pool + tab[i].name.off, pool + name->off, name->len) == 0) {
+            return &tab[i];
+        }
+    }
+    return NULL;
+}
+
+static void fold_record(FoldEntry* tab, int* count, const char* pool,
+                        const StrRef* name, int val, int known) {
+    FoldEntry* e = fold_find(tab, *count, pool, name);
+    if (!e) {
+        if (*count >= MAX_VARIABLES) return;
+        e = &tab[(*count)++];
+        e->name = *name;
+    }
+    e->val = val;
+    e->known = (uint8_t)known;
+}
+
+/* Fold OP_JMP_FALSE instructions whose operands are all known at compile
+ * time into unconditional jumps (condition false) or fall-through jumps
+ * (condition true). Known facts are discarded at every control-flow merge,
+ * so each fold can expose the next one - iterate until nothing changes. */
+static void fold_literal_conditions(CfgProgram* prog) {
+    uint8_t* is_target = (uint8_t*)malloc((size_t)prog->count + 1);
+    FoldEntry* tab = (FoldEntry*)malloc(MAX_VARIABLES * sizeof(FoldEntry));
+    if (!is_target || !tab) {
+        free(is_target);
+        free(tab);
+        return;
+    }
+
+    int changed = 1;
+    while (changed) {
+        changed = 0;
+
+        /* Mark control-flow merge points; a jump to the very next
+         * instruction is a fall-through, not a merge */
+        memset(is_target, 0, (size_t)prog->count + 1);
+        for (int i = 0; i < prog->count; i++) {
+            const Instr* ins = &prog->code[i];
+            if ((ins->op == OP_JMP_FALSE || ins->op == OP_JMP) &&
+                ins->u.jmp.target != i + 1) {
+                is_target[ins->u.jmp.target] = 1;
+            }
+        }
+
+        int known_count = 0;
+        for (int i = 0; i < prog->count; i++) {
+            Instr* ins = &prog->code[i];
+            if (is_target[i]) {
+                known_count = 0;
+            }
+            switch (ins->op) {
+            case OP_SET_INT:
+                fold_record(tab, &known_count, prog->pool, &ins->name,
+                            ins->u.int_val, 1);
+                break;
+            case OP_SET_STR:
+            case OP_SET_COPY:
+                fold_record(tab, &known_count, prog->pool, &ins->name, 0, 0);
+                break;
+            case OP_JMP_FALSE: {
+                int lhs, rhs, have = 1;
+                FoldEntry* e;
+                if (ins->lhs_is_var) {
+                    e = fold_find(tab, known_count, prog->pool, &ins->u.jmp.lhs);
+                    have = e && e->known;
+                    lhs = have ? e->val : 0;
+                } else {
+                    lhs = ins->u.jmp.lhs_int;
+                }
+                if (have && ins->rhs_is_var) {
+                    e = fold_find(tab, known_count, prog->pool, &ins->u.jmp.rhs);
+                    have = e && e->known;
+                    rhs = have ? e->val : 0;
+                } else {
+                    rhs = ins->u.jmp.rhs_int;
+                }
+                if (have) {
+                    int rel = (lhs < rhs) ? CMP_LT : (lhs > rhs) ? CMP_GT : CMP_EQ;
+                    int target = (rel & ins->cmp_mask) ? i + 1 : ins->u.jmp.target;
+                    ins->op = OP_JMP;
+                    ins->lhs_is_var = 0;
+                    ins->rhs_is_var = 0;
+                    ins->u.jmp.target = target;
+                    changed = 1;
+                }
+                break;
+            }
+            default:
+                break;
+            }
+        }
+    }
+
+    free(is_target);
+    free(tab);
+}
+
+/* Drop instructions no execution path can reach, plus jumps that only fall
+ * through, compacting the stream and remapping the surviving targets */
+static void prune_dead_code(CfgProgram* prog) {
+    uint8_t* keep = (uint8_t*)calloc((size_t)prog->count + 1, 1);
+    int* remap = (int*)malloc(((size_t)prog->count + 1) * sizeof(int));
+    if (!keep || !remap) {
+        free(keep);
+        free(remap);
+        return;
+    }
+
+    /* Reachability walk from the entry point */
+    int* work = remap; /* reuse the remap array as the worklist */
+    int top = 0;
+    if (prog->count > 0) {
+        work[top++] = 0;
+    }
+    while (top > 0) {
+        int i = work[--top];
+        if (i >= prog->count || keep[i]) continue;
+        keep[i] = 1;
+        const Instr* ins = &prog->code[i];
+        if (ins->op == OP_JMP) {
+            work[top++] = ins->u.jmp.target;
+        } else {
+            if (ins->op == OP_JMP_FALSE) {
+                work[top++] = ins->u.jmp.target;
+            }
+            work[top++] = i + 1;
+        }
+    }
+
+    /* Two trims share the compaction below: unreachable instructions, and
+     * OP_JMPs that now target the instruction right after them */
+    int trimmed = 1;
+    while (trimmed) {
+        trimmed = 0;
+        int n = 0;
+        for (int i = 0; i < prog->count; i++) {
+            remap[i] = n;
+            if (keep[i]) n++;
+        }
+        remap[prog->count] = n;
+        for (int i = 0; i < prog->count; i++) {
+            if (!keep[i]) continue;
+            Instr* ins = &prog->code[i];
+            if (ins->op == OP_JMP && remap[ins->u.jmp.target] == remap[i] + 1) {
+                keep[i] = 0;
+                trimmed = 1;
+            }
+        }
+    }
+
+    int n = 0;
+    for (int i = 0; i < prog->count; i++) {
+        remap[i] = n;
+        if (keep[i]) n++;
+    }
+    remap[prog->count] = n;
+    n = 0;
+    for (int i = 0; i < prog->count; i++) {
+        if (!keep[i]) continue;
+        Instr ins = prog->code[i];
+        if (ins.op == OP_JMP || ins.op == OP_JMP_FALSE) {
+            ins.u.jmp.target = remap[ins.u.jmp.target];
+        }
+        prog->code[n++] = ins;
+    }
+    prog->count = n;
+
+    free(keep);
+    free(remap);
+}
+
+static void optimize_program(CfgProgram* prog, unsigned flags) {
+    if (flags & CFG_OPT_FOLD_LITERALS) {
+        fold_literal_conditions(prog);
+    }
+    if (flags & CFG_OPT_DCE) {
+        prune_dead_code(prog);
+    }
+}
+
+/* ========================================================================
+ * EXECUTOR
+ * ======================================================================== */
+
+/* Resolve the target variable of an OP_SET_* instruction, creating it on
+ * first assignment and enforcing const - same order of effects as the old
+ * direct interpreter */
+static int exec_set_target(ConfigLang* cfg, const CfgProgram* prog,
+                           const Instr* ins, int* slot_out) {
+    const char* name = prog->pool + ins->name.off;
+    int slot = find_variable(cfg, name, ins->name.len, ins->name.hash);
+    if (slot >= 0) {
+        if (cfg->is_const[slot]) {
+            set_error(cfg, ERR_CFG_CONST_VIOLATION, "Cannot modify const variable",
+                      prog_line(prog, ins->src_pos));
+            return ERR_CFG_CONST_VIOLATION;
+        }
+    } else {
+        slot = create_variable(cfg, name, ins->name.len, ins->name.hash);
+        if (slot < 0) {
+            set_error(cfg, ERR_CFG_OUT_OF_MEMORY, "Too many variables",
+                      prog_line(prog, ins->src_pos));
+            return ERR_CFG_OUT_OF_MEMORY;
+        }
+        cfg->is_const[slot] = ins->is_const;
+    }
+    *slot_out = slot;
+    return ERR_CFG_OK;
+}
+
+/* Fetch one comparison operand (literal or integer variable) */
+static int exec_cond_operand(ConfigLang* cfg, const CfgProgram* prog,
+                             const Instr* ins, int is_var, const StrRef* ref,
+                             int lit, int* out) {
+    if (!is_var) {
+        *out = lit;
+        return ERR_CFG_OK;
+    }
+    int slot = find_variable(cfg, prog->pool + ref->off, ref->len, ref->hash);
+    if (CFG_UNLIKELY(slot < 0)) {
+        set_error(cfg, ERR_CFG_VARIABLE_NOT_FOUND, "Variable not found in condition",
+                  prog_line(prog, ins->src_pos));
+        return ERR_CFG_VARIABLE_NOT_FOUND;
+    }
+    if (CFG_UNLIKELY(cfg->types[slot] != VAR_TYPE_INT)) {
+        set_error(cfg, ERR_CFG_TYPE_MISMATCH, "Condition requires integer",
+                  prog_line(prog, ins->src_pos));
+        return ERR_CFG_TYPE_MISMATCH;
+    }
+    *out = cfg->values[slot].int_val;
+    return ERR_CFG_OK;
+}
+
+/* Run a compiled program against the instance's variables.
+ *
+ * Under GCC/Clang dispatch is direct-threaded: every handler ends in its
+ * own indirect jump through the label table, so the branch predictor keeps
+ * one history entry per handler instead of funnelling every opcode through
+ * a single switch jump. The VM_CASE/VM_NEXT macro pair keeps the handler
+ * bodies shared with the portable switch build. */
+static int run_program(ConfigLang* cfg, CfgProgram* prog) {
+    int ip = 0;
+    const Instr* ins;
+    int err, slot;
+
+#ifdef CFG_USE_COMPUTED_GOTO
+#define VM_CASE(name) lbl_##name
+#define VM_NEXT()                                \
+    do {                                         \
+        if (ip >= prog->count) return ERR_CFG_OK; \
+        ins = &prog->code[ip];                   \
+        goto *dispatch[ins->op];                 \
+    } while (0)
+    static const void* const dispatch[] = {
+        &&lbl_OP_SET_INT, &&lbl_OP_SET_STR, &&lbl_OP_SET_COPY,
+        &&lbl_OP_JMP_FALSE, &&lbl_OP_JMP
+    };
+    VM_NEXT();
+#else
+#define VM_CASE(name) case name
+#define VM_NEXT() break
+    while (ip < prog->count) {
+        ins = &prog->code[ip];
+        switch (ins->op) {
+#endif
+
+    VM_CASE(OP_SET_INT):
+        err = exec_set_target(cfg, prog, ins, &slot);
+        if (CFG_UNLIKELY(err != ERR_CFG_OK)) return err;
+        clear_value(cfg, slot);
+        cfg->types[slot] = VAR_TYPE_INT;
+        cfg->values[slot].int_val = ins->u.int_val;
+        ip++;
+        VM_NEXT();
+
+    VM_CASE(OP_SET_STR):
+        err = exec_set_target(cfg, prog, ins, &slot);
+        if (CFG_UNLIKELY(err != ERR_CFG_OK)) return err;
+        if (ins->u.str.len > CFG_SSO_MAX && ins->u.str.len <= MAX_STRING_VALUE - 1) {
+            /* Pool entries are NUL-terminated, so the variable can reference
+             * the pool bytes directly - no allocation, no copy. The program
+             * is flagged so its pool outlives it if it gets evicted. */
+            clear_value(cfg, slot);
+            cfg->types[slot] = VAR_TYPE_STRING;
+            cfg->values[slot].str.len = (uint16_t)ins->u.str.len;
+            cfg->values[slot].str.borrowed = 1;
+            cfg->values[slot].str.data = prog->pool + ins->u.str.off;
+            prog->pool_borrowed = 1;
+        } else {
+            /* Short payloads go inline; oversized ones need the clamped copy */
+            err = store_string_value(cfg, slot, prog->pool + ins->u.str.off,
+                                     ins->u.str.len);
+            if (CFG_UNLIKELY(err != ERR_CFG_OK)) {
+                set_error(cfg, err, "Out of memory", prog_line(prog, ins->src_pos));
+                return err;
+            }
+        }
+        ip++;
+        VM_NEXT();
+
+    VM_CASE(OP_SET_COPY): {
+        err = exec_set_target(cfg, prog, ins, &slot);
+        if (CFG_UNLIKELY(err != ERR_CFG_OK)) return err;
+        int src = find_variable(cfg, prog->pool + ins->u.src.off,
+                                ins->u.src.len, ins->u.src.hash);
+        if (CFG_UNLIKELY(src < 0)) {
+            set_error(cfg, ERR_CFG_VARIABLE_NOT_FOUND, "Variable not found",
+                      prog_line(prog, ins->src_pos));
+            return ERR_CFG_VARIABLE_NOT_FOUND;
+        }
+        if (cfg->types[src] == VAR_TYPE_INT) {
+            clear_value(cfg, slot);
+            cfg->types[slot] = VAR_TYPE_INT;
+            cfg->values[slot].int_val = cfg->values[src].int_val;
+        } else if (cfg->values[src].str.len > CFG_SSO_MAX &&
+                   cfg->values[src].str.borrowed) {
+            /* Both slots can reference the same pool bytes; staging through
+             * a local keeps self-assignment safe */
+            VarValue sv = cfg->values[src];
+            clear_value(cfg, slot);
+            cfg->types[slot] = VAR_TYPE_STRING;
+            cfg->values[slot].str = sv.str;
+        } else {
+            err = store_string_value(cfg, slot, VALUE_STR(&cfg->values[src]),
+                                     cfg->values[src].str.len);
+            if (CFG_UNLIKELY(err != ERR_CFG_OK)) {
+                set_error(cfg, err, "Out of memory", prog_line(prog, ins->src_pos));
+                return err;
+            }
+        }
+        ip++;
+        VM_NEXT();
+    }
+
+    VM_CASE(OP_JMP_FALSE): {
+        int left_val, right_val;
+        err = exec_cond_operand(cfg, prog, ins, ins->lhs_is_var,
+                                &ins->u.jmp.lhs, ins->u.jmp.lhs_int, &left_val);
+        if (CFG_UNLIKELY(err != ERR_CFG_OK)) return err;
+        err = exec_cond_operand(cfg, prog, ins, ins->rhs_is_var,
+                                &ins->u.jmp.rhs, ins->u.jmp.rhs_int, &right_val);
+        if (CFG_UNLIKELY(err != ERR_CFG_OK)) return err;
+
+        /* Classify the operand pair as less/equal/greater bits and AND
+         * against the mask baked in at compile time - no per-operator
+         * branching or table lookup at execution */
+        int rel = (left_val < right_val) ? CMP_LT
+                : (left_val > right_val) ? CMP_GT : CMP_EQ;
+        if (rel & ins->cmp_mask) {
+            ip++;
+        } else {
+            ip = ins->u.jmp.target;
+        }
+        VM_NEXT();
+    }
+
+    VM_CASE(OP_JMP):
+#ifndef CFG_USE_COMPUTED_GOTO
+    default:
+#endif
+        ip = ins->u.jmp.target;
+        VM_NEXT();
+
+#ifndef CFG_USE_COMPUTED_GOTO
         }
     }
-    
     return ERR_CFG_OK;
+#endif
+#undef VM_CASE
+#undef VM_NEXT
 }
 
 /* ========================================================================
@@ -643,148 +1524,471 @@ ConfigLang* cfg_create(void) {
     return cfg;
 }
 
+/* Free a program that is leaving the cache. If any variable still holds a
+ * view into its pool, the pool is moved to the retained list and freed with
+ * the variables (cfg_reset / cfg_destroy) instead of with the program. */
+static void retire_program(ConfigLang* cfg, CfgProgram* prog) {
+    if (!prog) return;
+    if (prog->pool_borrowed && prog->pool) {
+        if (cfg->retained_count == cfg->retained_cap) {
+            int grown_cap = cfg->retained_cap ? cfg->retained_cap * 2 : 4;
+            char** grown = (char**)realloc(cfg->retained_pools,
+                                           (size_t)grown_cap * sizeof(char*));
+            if (!grown) {
+                /* Cannot track the pool, and freeing it would dangle the
+                 * variables referencing it - leaking it is the safe fallback */
+                prog->pool = NULL;
+                free_program(prog);
+                return;
+            }
+            cfg->retained_pools = grown;
+            cfg->retained_cap = grown_cap;
+        }
+        cfg->retained_pools[cfg->retained_count++] = prog->pool;
+        prog->pool = NULL;
+    }
+    free_program(prog);
+}
+
+/* Drop the retained pools once no variable can reference them anymore */
+static void free_retained_pools(ConfigLang* cfg) {
+    for (int i = 0; i < cfg->retained_count; i++) {
+        free(cfg->retained_pools[i]);
+    }
+    free(cfg->retained_pools);
+    cfg->retained_pools = NULL;
+    cfg->retained_count = 0;
+    cfg->retained_cap = 0;
+}
+
 void cfg_destroy(ConfigLang* cfg) {
     if (cfg) {
+        for (int i = 0; i < cfg->var_count; i++) {
+            clear_value(cfg, i);
+        }
+        for (int i = 0; i < CFG_PROGRAM_CACHE; i++) {
+            free_program(cfg->progs[i]);
+        }
+        free_retained_pools(cfg);
         free(cfg);
     }
 }
 
-int cfg_load_string(ConfigLang* cfg, const char* code) {
+int cfg_reset(ConfigLang* cfg) {
+    if (!cfg) return ERR_CFG_NULL_POINTER;
+
+    /* Drop all variables but keep the instance itself, so callers running
+     * many small configs reuse one allocation instead of a destroy/create
+     * pair per run. The compiled-program cache survives: it is keyed by
+     * source bytes, not by variable state. */
+    for (int i = 0; i < cfg->var_count; i++) {
+        clear_value(cfg, i);
+    }
+    memset(cfg->slot_id, 0, sizeof(cfg->slot_id));
+    cfg->var_count = 0;
+    /* No variable can reference a program pool anymore */
+    free_retained_pools(cfg);
+    for (int i = 0; i < CFG_PROGRAM_CACHE; i++) {
+        if (cfg->progs[i]) {
+            cfg->progs[i]->pool_borrowed = 0;
+        }
+    }
+    cfg->last_error = ERR_CFG_OK;
+    strcpy(cfg->error_msg, "No error");
+    return ERR_CFG_OK;
+}
+
+/* Loader core - the buffer does not need to be NUL-terminated, so callers
+ * that already know the byte count avoid an extra strlen pass. Compiled
+ * programs are cached: a reload of byte-identical source (hash, length and
+ * an exact memcmp all match) skips straight to execution. */
+int cfg_load_buffer(ConfigLang* restrict cfg, const char* restrict buf, size_t length) {
+    if (CFG_UNLIKELY(!cfg || (!buf && length > 0))) return ERR_CFG_NULL_POINTER;
+    if (!buf) buf = "";
+
+    uint64_t h = hash_source(buf, length);
+
+    CfgProgram* prog = NULL;
+    int free_slot = -1;
+    int evict = 0;
+    for (int i = 0; i < CFG_PROGRAM_CACHE; i++) {
+        CfgProgram* cand = cfg->progs[i];
+        if (!cand) {
+            if (free_slot < 0) free_slot = i;
+            continue;
+        }
+        if (cand->src_hash == h && cand->src_len == length &&
+            memcmp(cand->src, buf, length) == 0) {
+            prog = cand;
+            break;
+        }
+        if (!cfg->progs[evict] || cand->stamp < cfg->progs[evict]->stamp) {
+            evict = i;
+        }
+    }
+
+    if (!prog) {
+        int err;
+        prog = compile_source(cfg, buf, length, h, &err);
+        if (!prog) {
+            return err;
+        }
+        int dst = free_slot >= 0 ? free_slot : evict;
+        retire_program(cfg, cfg->progs[dst]);
+        cfg->progs[dst] = prog;
+    }
+    prog->stamp = ++cfg->prog_stamp;
+
+    return run_program(cfg, prog);
+}
+
+int cfg_load_string(ConfigLang* restrict cfg, const char* restrict code) {
     if (!cfg || !code) return ERR_CFG_NULL_POINTER;
-    
-    Lexer lex;
-    lexer_init(&lex, code);
-    
-    Parser parser;
-    parser_init(&parser, &lex, cfg);
-    
-    int result = parse_program(&parser);
-    return result;
+
+    return cfg_load_buffer(cfg, code, strlen(code));
 }
 
-int cfg_load_file(ConfigLang* cfg, const char* path) {
+int cfg_load_file(ConfigLang* restrict cfg, const char* restrict path) {
     if (!cfg || !path) return ERR_CFG_NULL_POINTER;
-    
-    FILE* f = fopen(path, "r");
+
+    FILE* f;
+#ifdef CFG_USE_MMAP
+    /* Map regular files and feed the mapping to the loader directly,
+     * skipping the stdio read loop and its staging buffer (the compiler
+     * still takes its own copy of the source on a program-cache miss).
+     * Non-regular files and mmap failures fall back to stdio. */
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) {
+        set_error(cfg, ERR_CFG_FILE_ERROR, "Cannot open file", 0);
+        return ERR_CFG_FILE_ERROR;
+    }
+
+    struct stat st;
+    if (fstat(fd, &st) == 0 && S_ISREG(st.st_mode)) {
+        if (st.st_size == 0) {
+            close(fd);
+            return cfg_load_buffer(cfg, "", 0);
+        }
+        void* map = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (map != MAP_FAILED) {
+            close(fd);
+            /* The lexer walks the source front to back exactly once, so
+             * ask the kernel for aggressive sequential readahead */
+            posix_madvise(map, (size_t)st.st_size, POSIX_MADV_SEQUENTIAL);
+            int result = cfg_load_buffer(cfg, (const char*)map, (size_t)st.st_size);
+            munmap(map, (size_t)st.st_size);
+            return result;
+        }
+    }
+
+    /* Hand the already-open descriptor to stdio rather than re-opening the
+     * path: on a FIFO the open above connected the writer, so a second open
+     * would discard whatever it wrote and block waiting for a new one, and
+     * re-resolving the name could race a rename */
+    f = fdopen(fd, "r");
     if (!f) {
+        close(fd);
         set_error(cfg, ERR_CFG_FILE_ERROR, "Cannot open file", 0);
         return ERR_CFG_FILE_ERROR;
     }
-    
-    /* Read entire file */
-    fseek(f, 0, SEEK_END);
-    long size = ftell(f);
-    fseek(f, 0, SEEK_SET);
-    
-    char* buffer = (char*)malloc(size + 1);
+#else
+    f = fopen(path, "r");
+    if (!f) {
+        set_error(cfg, ERR_CFG_FILE_ERROR, "Cannot open file", 0);
+        return ERR_CFG_FILE_ERROR;
+    }
+#endif
+
+    /* Read in 64 KiB blocks into one contiguous buffer - bulk fread rather
+     * than per-character stdio, and no fseek/ftell size probe, so pipes and
+     * other non-seekable streams the mmap path rejects also load fine */
+    size_t cap = 65536;
+    size_t len = 0;
+    char* buffer = (char*)malloc(cap);
     if (!buffer) {
         fclose(f);
         set_error(cfg, ERR_CFG_OUT_OF_MEMORY, "Out of memory", 0);
         return ERR_CFG_OUT_OF_MEMORY;
     }
-    
-    size_t read = fread(buffer, 1, size, f);
-    buffer[read] = '\0';
+
+    size_t got;
+    while ((got = fread(buffer + len, 1, cap - len, f)) > 0) {
+        len += got;
+        if (len == cap) {
+            size_t grown_cap = cap * 2;
+            char* grown = (char*)realloc(buffer, grown_cap);
+            if (!grown) {
+                free(buffer);
+                fclose(f);
+                set_error(cfg, ERR_CFG_OUT_OF_MEMORY, "Out of memory", 0);
+                return ERR_CFG_OUT_OF_MEMORY;
+            }
+            buffer = grown;
+            cap = grown_cap;
+        }
+    }
     fclose(f);
-    
-    int result = cfg_load_string(cfg, buffer);
+
+    int result = cfg_load_buffer(cfg, buffer, len);
     free(buffer);
-    
+
     return result;
 }
 
-int cfg_get_int(ConfigLang* cfg, const char* name, int* out) {
-    if (!cfg || !name || !out) return ERR_CFG_NULL_POINTER;
-    
-    Variable* var = find_variable(cfg, name);
-    if (!var) {
+int cfg_get_int(ConfigLang* restrict cfg, const char* restrict name, int* restrict out) {
+    if (CFG_UNLIKELY(!cfg || !name || !out)) return ERR_CFG_NULL_POINTER;
+
+    int slot = find_variable(cfg, name, strlen(name), hash_name(name));
+    if (CFG_UNLIKELY(slot < 0)) {
         set_error(cfg, ERR_CFG_VARIABLE_NOT_FOUND, "Variable not found", 0);
         return ERR_CFG_VARIABLE_NOT_FOUND;
     }
-    
-    if (var->type != VAR_TYPE_INT) {
+
+    if (cfg->types[slot] != VAR_TYPE_INT) {
         set_error(cfg, ERR_CFG_TYPE_MISMATCH, "Variable is not an integer", 0);
         return ERR_CFG_TYPE_MISMATCH;
     }
-    
-    *out = var->value.int_val;
+
+    *out = cfg->values[slot].int_val;
     return ERR_CFG_OK;
 }
 
-int cfg_get_string(ConfigLang* cfg, const char* name, const char** out) {
-    if (!cfg || !name || !out) return ERR_CFG_NULL_POINTER;
-    
-    Variable* var = find_variable(cfg, name);
-    if (!var) {
+int cfg_get_string(ConfigLang* restrict cfg, const char* restrict name, const char** restrict out) {
+    if (CFG_UNLIKELY(!cfg || !name || !out)) return ERR_CFG_NULL_POINTER;
+
+    int slot = find_variable(cfg, name, strlen(name), hash_name(name));
+    if (CFG_UNLIKELY(slot < 0)) {
         set_error(cfg, ERR_CFG_VARIABLE_NOT_FOUND, "Variable not found", 0);
         return ERR_CFG_VARIABLE_NOT_FOUND;
     }
-    
-    if (var->type != VAR_TYPE_STRING) {
+
+    if (cfg->types[slot] != VAR_TYPE_STRING) {
         set_error(cfg, ERR_CFG_TYPE_MISMATCH, "Variable is not a string", 0);
         return ERR_CFG_TYPE_MISMATCH;
     }
-    
-    *out = var->value.str_val;
+
+    *out = VALUE_STR(&cfg->values[slot]);
+    return ERR_CFG_OK;
+}
+
+CfgSym cfg_intern(ConfigLang* restrict cfg, const char* restrict name) {
+    if (!cfg || !name) return CFG_SYM_INVALID;
+
+    /* Dense variable ids are stable until cfg_reset/cfg_destroy, so the
+     * id itself is the handle - one hash here, pure indexing afterwards */
+    int slot = find_variable(cfg, name, strlen(name), hash_name(name));
+    return slot < 0 ? CFG_SYM_INVALID : (CfgSym)slot;
+}
+
+int cfg_get_int_sym(ConfigLang* restrict cfg, CfgSym sym, int* restrict out) {
+    if (CFG_UNLIKELY(!cfg || !out)) return ERR_CFG_NULL_POINTER;
+
+    if (CFG_UNLIKELY(sym >= (CfgSym)cfg->var_count)) {
+        set_error(cfg, ERR_CFG_VARIABLE_NOT_FOUND, "Invalid variable handle", 0);
+        return ERR_CFG_VARIABLE_NOT_FOUND;
+    }
+
+    if (cfg->types[sym] != VAR_TYPE_INT) {
+        set_error(cfg, ERR_CFG_TYPE_MISMATCH, "Variable is not an integer", 0);
+        return ERR_CFG_TYPE_MISMATCH;
+    }
+
+    *out = cfg->values[sym].int_val;
     return ERR_CFG_OK;
 }
 
-int cfg_set_int(ConfigLang* cfg, const char* name, int value) {
+int cfg_get_string_sym(ConfigLang* restrict cfg, CfgSym sym, const char** restrict out) {
+    if (CFG_UNLIKELY(!cfg || !out)) return ERR_CFG_NULL_POINTER;
+
+    if (CFG_UNLIKELY(sym >= (CfgSym)cfg->var_count)) {
+        set_error(cfg, ERR_CFG_VARIABLE_NOT_FOUND, "Invalid variable handle", 0);
+        return ERR_CFG_VARIABLE_NOT_FOUND;
+    }
+
+    if (cfg->types[sym] != VAR_TYPE_STRING) {
+        set_error(cfg, ERR_CFG_TYPE_MISMATCH, "Variable is not a string", 0);
+        return ERR_CFG_TYPE_MISMATCH;
+    }
+
+    *out = VALUE_STR(&cfg->values[sym]);
+    return ERR_CFG_OK;
+}
+
+int cfg_get_batch(ConfigLang* restrict cfg, const CfgQuery* restrict queries, size_t n) {
+    if (!cfg || (!queries && n > 0)) return ERR_CFG_NULL_POINTER;
+
+    /* Resolve every key in one pass; keys are hashed once each and the
+     * dense ids make each probe a couple of cache lines. All queries are
+     * attempted even after a failure so callers get every value that does
+     * exist, and the first error is what gets reported. */
+    int first_err = ERR_CFG_OK;
+    for (size_t i = 0; i < n; i++) {
+        const CfgQuery* q = &queries[i];
+        int err;
+        if (!q->key || !q->out) {
+            err = ERR_CFG_NULL_POINTER;
+        } else if (q->type == CFG_TYPE_INT) {
+            err = cfg_get_int(cfg, q->key, (int*)q->out);
+        } else {
+            err = cfg_get_string(cfg, q->key, (const char**)q->out);
+        }
+        if (CFG_UNLIKELY(err != ERR_CFG_OK) && first_err == ERR_CFG_OK) {
+            first_err = err;
+        }
+    }
+    return first_err;
+}
+
+int cfg_set_int(ConfigLang* restrict cfg, const char* restrict name, int value) {
     if (!cfg || !name) return ERR_CFG_NULL_POINTER;
     
-    Variable* var = find_variable(cfg, name);
-    if (!var) {
+    int slot = find_variable(cfg, name, strlen(name), hash_name(name));
+    if (slot < 0) {
         set_error(cfg, ERR_CFG_VARIABLE_NOT_FOUND, "Variable not found", 0);
         return ERR_CFG_VARIABLE_NOT_FOUND;
     }
-    
-    if (var->is_const) {
+
+    if (cfg->is_const[slot]) {
         set_error(cfg, ERR_CFG_CONST_VIOLATION, "Cannot modify const variable", 0);
         return ERR_CFG_CONST_VIOLATION;
     }
-    
-    if (var->type != VAR_TYPE_INT) {
+
+    if (cfg->types[slot] != VAR_TYPE_INT) {
         set_error(cfg, ERR_CFG_TYPE_MISMATCH, "Variable is not an integer", 0);
         return ERR_CFG_TYPE_MISMATCH;
     }
-    
-    var->value.int_val = value;
+
+    cfg->values[slot].int_val = value;
+    return ERR_CFG_OK;
+}
+
+int cfg_set_optimization(ConfigLang* cfg, unsigned flags) {
+    if (!cfg) return ERR_CFG_NULL_POINTER;
+
+    if (cfg->opt_flags != flags) {
+        cfg->opt_flags = flags;
+        /* Cached programs were compiled under the old passes - drop them so
+         * the next load of each source recompiles with the new ones */
+        for (int i = 0; i < CFG_PROGRAM_CACHE; i++) {
+            retire_program(cfg, cfg->progs[i]);
+            cfg->progs[i] = NULL;
+        }
+    }
+    return ERR_CFG_OK;
+}
+
+/* Grow the save buffer so it can hold at least `need` more bytes */
+static int save_reserve(char** out, size_t* cap, size_t len, size_t need) {
+    if (len + need <= *cap) {
+        return ERR_CFG_OK;
+    }
+    size_t grown_cap = *cap;
+    while (grown_cap < len + need) {
+        grown_cap *= 2;
+    }
+    char* grown = (char*)realloc(*out, grown_cap);
+    if (!grown) {
+        return ERR_CFG_OUT_OF_MEMORY;
+    }
+    *out = grown;
+    *cap = grown_cap;
+    return ERR_CFG_OK;
+}
+
+int cfg_save_buffer(ConfigLang* restrict cfg, char** restrict out_buf, size_t* restrict out_len) {
+    if (!cfg || !out_buf || !out_len) return ERR_CFG_NULL_POINTER;
+
+    /* Format everything into one memory buffer; cfg_save_file hands this
+     * to the OS with a single write, and in-memory consumers can feed it
+     * straight back to cfg_load_buffer without touching the filesystem */
+    size_t cap = 4096;
+    size_t len = 0;
+    char* out = (char*)malloc(cap);
+    if (!out) {
+        set_error(cfg, ERR_CFG_OUT_OF_MEMORY, "Out of memory", 0);
+        return ERR_CFG_OUT_OF_MEMORY;
+    }
+
+    /* Dense ids are packed in creation order, so this walks exactly the
+     * live variables and the saved file preserves definition order */
+    for (int i = 0; i < cfg->var_count; i++) {
+        /* Worst case for one entry: keywords, a full-length name, an int or
+         * the string payload plus multiline markers */
+        size_t need = 64;
+        if (cfg->types[i] == VAR_TYPE_STRING) {
+            need += (size_t)cfg->values[i].str.len + 16;
+        }
+        if (save_reserve(&out, &cap, len, need) != ERR_CFG_OK) {
+            free(out);
+            set_error(cfg, ERR_CFG_OUT_OF_MEMORY, "Out of memory", 0);
+            return ERR_CFG_OUT_OF_MEMORY;
+        }
+
+        if (cfg->is_const[i]) {
+            memcpy(out + len, "const ", 6);
+            len += 6;
+        }
+        memcpy(out + len, "set ", 4);
+        len += 4;
+        size_t name_len = strlen(cfg->names[i]);
+        memcpy(out + len, cfg->names[i], name_len);
+        len += name_len;
+        memcpy(out + len, " = ", 3);
+        len += 3;
+
+        if (cfg->types[i] == VAR_TYPE_INT) {
+            len += (size_t)snprintf(out + len, cap - len, "%d\n", cfg->values[i].int_val);
+        } else {
+            const char* s = VALUE_STR(&cfg->values[i]);
+            size_t slen = cfg->values[i].str.len;
+            /* Check if string contains newlines */
+            if (memchr(s, '\n', slen)) {
+                memcpy(out + len, "#%%%\n", 5);
+                len += 5;
+                memcpy(out + len, s, slen);
+                len += slen;
+                memcpy(out + len, "\n%%%#\n", 6);
+                len += 6;
+            } else {
+                out[len++] = '"';
+                memcpy(out + len, s, slen);
+                len += slen;
+                out[len++] = '"';
+                out[len++] = '\n';
+            }
+        }
+    }
+
+    *out_buf = out;
+    *out_len = len;
     return ERR_CFG_OK;
 }
 
-int cfg_save_file(ConfigLang* cfg, const char* path) {
+int cfg_save_file(ConfigLang* restrict cfg, const char* restrict path) {
     if (!cfg || !path) return ERR_CFG_NULL_POINTER;
-    
+
+    char* out;
+    size_t len;
+    int err = cfg_save_buffer(cfg, &out, &len);
+    if (err != ERR_CFG_OK) {
+        return err;
+    }
+
     FILE* f = fopen(path, "w");
     if (!f) {
+        free(out);
         set_error(cfg, ERR_CFG_FILE_ERROR, "Cannot open file for writing", 0);
         return ERR_CFG_FILE_ERROR;
     }
-    
-    for (int i = 0; i < MAX_VARIABLES; i++) {
-        if (cfg->variables[i].in_use) {
-            Variable* var = &cfg->variables[i];
-            
-            if (var->is_const) {
-                fprintf(f, "const ");
-            }
-            
-            fprintf(f, "set %s = ", var->name);
-            
-            if (var->type == VAR_TYPE_INT) {
-                fprintf(f, "%d\n", var->value.int_val);
-            } else {
-                /* Check if string contains newlines */
-                if (strchr(var->value.str_val, '\n')) {
-                    fprintf(f, "#%%%%%%\n%s\n%%%%%%#\n", var->value.str_val);
-                } else {
-                    fprintf(f, "\"%s\"\n", var->value.str_val);
-                }
-            }
-        }
-    }
-    
+
+    size_t written = fwrite(out, 1, len, f);
     fclose(f);
+    free(out);
+
+    if (written != len) {
+        set_error(cfg, ERR_CFG_FILE_ERROR, "Cannot write file", 0);
+        return ERR_CFG_FILE_ERROR;
+    }
     return ERR_CFG_OK;
 }
 
@@ -8,10 +8,34 @@
 #ifndef CONFIGLANG_H
 #define CONFIGLANG_H
 
+#include <stddef.h>
+#include <stdint.h>
+
 #ifdef __cplusplus
 extern "C" {
 #endif
 
+/* Branch-prediction hints for status-code checks: nearly every call in a
+ * healthy program returns ERR_CFG_OK, so marking the error branch unlikely
+ * keeps the OK path as straight-line fall-through code. No-ops off GCC/Clang. */
+#if defined(__GNUC__)
+#define CFG_LIKELY(x)   __builtin_expect(!!(x), 1)
+#define CFG_UNLIKELY(x) __builtin_expect(!!(x), 0)
+#else
+#define CFG_LIKELY(x)   (x)
+#define CFG_UNLIKELY(x) (x)
+#endif
+
+/* The API never passes aliasing pointers (instance, name and out always
+ * refer to distinct objects), so the signatures say so and let the
+ * compiler keep loads in registers across the calls. C++ has no restrict
+ * keyword, hence the macro. */
+#ifdef __cplusplus
+#define CFG_RESTRICT
+#else
+#define CFG_RESTRICT restrict
+#endif
+
 /* Error codes */
 #define ERR_CFG_OK                  0
 #define ERR_CFG_NULL_POINTER       -1
@@ -37,42 +61,123 @@ ConfigLang* cfg_create(void);
  */
 void cfg_destroy(ConfigLang* cfg);
 
+/**
+ * Reset an instance to its freshly-created state without freeing it,
+ * so it can be reused instead of a destroy/create round trip
+ * Returns: ERR_CFG_OK on success, error code otherwise
+ */
+int cfg_reset(ConfigLang* cfg);
+
 /**
  * Load and execute configuration from a file
  * Returns: ERR_CFG_OK on success, error code otherwise
  */
-int cfg_load_file(ConfigLang* cfg, const char* path);
+int cfg_load_file(ConfigLang* CFG_RESTRICT cfg, const char* CFG_RESTRICT path);
 
 /**
  * Load and execute configuration from a string
  * Returns: ERR_CFG_OK on success, error code otherwise
  */
-int cfg_load_string(ConfigLang* cfg, const char* code);
+int cfg_load_string(ConfigLang* CFG_RESTRICT cfg, const char* CFG_RESTRICT code);
+
+/**
+ * Load and execute configuration from a memory buffer of known length
+ * (the buffer does not need to be NUL-terminated)
+ * Returns: ERR_CFG_OK on success, error code otherwise
+ */
+int cfg_load_buffer(ConfigLang* CFG_RESTRICT cfg, const char* CFG_RESTRICT buf, size_t length);
 
 /**
  * Get integer value of a variable
  * Returns: ERR_CFG_OK on success, error code otherwise
  */
-int cfg_get_int(ConfigLang* cfg, const char* name, int* out);
+int cfg_get_int(ConfigLang* CFG_RESTRICT cfg, const char* CFG_RESTRICT name, int* CFG_RESTRICT out);
 
 /**
  * Get string value of a variable
  * Returns: ERR_CFG_OK on success, error code otherwise
  * Note: returned string is internal - do not free
  */
-int cfg_get_string(ConfigLang* cfg, const char* name, const char** out);
+int cfg_get_string(ConfigLang* CFG_RESTRICT cfg, const char* CFG_RESTRICT name, const char** CFG_RESTRICT out);
+
+/* Interned variable handle - resolves the name once, then reads are a
+ * direct index. Handles are invalidated by cfg_reset and cfg_destroy. */
+typedef uint32_t CfgSym;
+#define CFG_SYM_INVALID ((CfgSym)0xFFFFFFFFu)
+
+/**
+ * Intern a variable name into a reusable handle
+ * Returns: handle for the variable, or CFG_SYM_INVALID if it does not exist
+ */
+CfgSym cfg_intern(ConfigLang* CFG_RESTRICT cfg, const char* CFG_RESTRICT name);
+
+/**
+ * Get integer value of a variable by interned handle
+ * Returns: ERR_CFG_OK on success, error code otherwise
+ */
+int cfg_get_int_sym(ConfigLang* CFG_RESTRICT cfg, CfgSym sym, int* CFG_RESTRICT out);
+
+/**
+ * Get string value of a variable by interned handle
+ * Returns: ERR_CFG_OK on success, error code otherwise
+ * Note: returned string is internal - do not free
+ */
+int cfg_get_string_sym(ConfigLang* CFG_RESTRICT cfg, CfgSym sym, const char** CFG_RESTRICT out);
+
+/* Requested value type for a batch query */
+typedef enum {
+    CFG_TYPE_INT,
+    CFG_TYPE_STRING
+} CfgType;
+
+/**
+ * One entry of a batch lookup
+ * out must point at an int (CFG_TYPE_INT) or a const char* (CFG_TYPE_STRING)
+ */
+typedef struct {
+    const char* key;
+    CfgType type;
+    void* out;
+} CfgQuery;
+
+/**
+ * Look up several variables in one call
+ * Returns: ERR_CFG_OK if every query succeeded, otherwise the first
+ * error encountered (remaining queries are still attempted)
+ */
+int cfg_get_batch(ConfigLang* CFG_RESTRICT cfg, const CfgQuery* CFG_RESTRICT queries, size_t n);
 
 /**
  * Set integer value of a variable
  * Returns: ERR_CFG_OK on success, ERR_CFG_CONST_VIOLATION if variable is const
  */
-int cfg_set_int(ConfigLang* cfg, const char* name, int value);
+int cfg_set_int(ConfigLang* CFG_RESTRICT cfg, const char* CFG_RESTRICT name, int value);
+
+/* Optional compile-time optimization passes; all off by default */
+#define CFG_OPT_NONE          0u
+#define CFG_OPT_FOLD_LITERALS (1u << 0)  /* fold conditions whose operands are known */
+#define CFG_OPT_DCE           (1u << 1)  /* drop unreachable instructions */
+
+/**
+ * Choose which optimization passes run when source is compiled
+ * Takes effect for subsequent loads; cached programs are recompiled
+ * Returns: ERR_CFG_OK on success, error code otherwise
+ */
+int cfg_set_optimization(ConfigLang* cfg, unsigned flags);
 
 /**
  * Save current configuration state to a file
  * Returns: ERR_CFG_OK on success, error code otherwise
  */
-int cfg_save_file(ConfigLang* cfg, const char* path);
+int cfg_save_file(ConfigLang* CFG_RESTRICT cfg, const char* CFG_RESTRICT path);
+
+/**
+ * Serialize current configuration state into a malloc'd memory buffer;
+ * on success *out and *out_len receive the buffer and its length and the
+ * caller owns the buffer (free it with free())
+ * Returns: ERR_CFG_OK on success, error code otherwise
+ */
+int cfg_save_buffer(ConfigLang* CFG_RESTRICT cfg, char** CFG_RESTRICT out, size_t* CFG_RESTRICT out_len);
 
 /**
  * Get last error message (useful for debugging)